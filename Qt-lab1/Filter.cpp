@@ -9,23 +9,98 @@ T clamp(T value, T max, T min) {
 	return value;
 }
 
-QImage Filter::process(const QImage& img) {
-	QImage result(img);
+bool LoadKernel(const char* path, Kernel& kernel) {
+	char size[80];
+	std::ifstream ifs(path);
+	if (!ifs.is_open())
+		return false;
+	ifs.getline(size, 3, '\n');
+	int sizei = std::atoi(size);
+	//    ,   
+	if (sizei <= 0 || sizei % 2 == 0)
+		return false;
+	std::unique_ptr<float[]> tmp = std::make_unique<float[]>(sizei * sizei);
+
+	for (int i = 0; i < sizei * sizei; i++)
+	{
+		ifs.getline(size, 2, '\n');
+		tmp[i] = std::atoi(size);
+	}
+
+	kernel.SetKernel(tmp.get(), sizei / 2);
+	return true;
+}
 
-	for (int x = 0; x < img.width()/2; x++) 
-		for (int y = 0; y < img.height(); y++) {
+QRect Filter::regionRect(const QSize& size) const {
+	if (region == Region::LeftHalf)
+		return QRect(0, 0, size.width() / 2, size.height());
+	return QRect(0, 0, size.width(), size.height());
+}
+
+void Filter::processRect(const QImage& img, QImage& result, const QRect& rect) const {
+	for (int x = rect.left(); x <= rect.right(); x++)
+		for (int y = rect.top(); y <= rect.bottom(); y++) {
 			QColor color = calcNewPixelColor(img, x, y);
 			result.setPixelColor(x, y, color);
 		}
+}
+
+void Filter::processArea(const QImage& img, QImage& result, const QRect& rect) const {
+	if (img.format() == QImage::Format_Grayscale8 && supportsGray())
+		processGrayRect(img, result, rect);
+	else
+		processRect(img, result, rect);
+}
+
+QImage Filter::process(const QImage& img) {
+	QImage result(img);
+	prepare(img);
+	processArea(img, result, regionRect(img.size()));
 	return result;
 }
 
+QRect Filter::update(const QImage& img, QImage& result, const QRect& dirty) {
+	if (result.size() != img.size()) {
+		result = process(img);
+		return img.rect();
+	}
+
+	QRect area = regionRect(img.size());
+	QRect rect = footprint(dirty, img.size()) & area;
+	//       
+	QRect copied = dirty & img.rect();
+	for (int x = copied.left(); x <= copied.right(); x++)
+		for (int y = copied.top(); y <= copied.bottom(); y++)
+			if (!area.contains(x, y))
+				result.setPixelColor(x, y, img.pixelColor(x, y));
+
+	if (!rect.isEmpty()) {
+		prepare(img);
+		processArea(img, result, rect);
+	}
+	return rect | copied;
+}
+
 QColor InvertFilter::calcNewPixelColor(const QImage& img, int x, int y) const {
 	QColor color = img.pixelColor(x, y);
 	color.setRgb(255 - color.red(), 255 - color.green(), 255 - color.blue());
 	return color;
 }
 
+void InvertFilter::processGrayRect(const QImage& img, QImage& result, const QRect& rect) const {
+	for (int y = rect.top(); y <= rect.bottom(); y++) {
+		const uchar* in = img.constScanLine(y);
+		uchar* out = result.scanLine(y);
+		for (int x = rect.left(); x <= rect.right(); x++)
+			out[x] = 255 - in[x];
+	}
+}
+
+QRect MatrixFilter::footprint(const QRect& dirty, const QSize& size) const {
+	int radius = mKernel.getRadius();
+	return dirty.adjusted(-radius, -radius, radius, radius);
+}
+
 QColor MatrixFilter::calcNewPixelColor(const QImage& img, int x, int y) const {
 	float returnR = 0;
 	float returnG = 0;
@@ -36,7 +111,7 @@ QColor MatrixFilter::calcNewPixelColor(const QImage& img, int x, int y) const {
 		for (int j = -radius; j <= radius; j++) {
 			int idx = (i + radius) * size + j + radius;
 			QColor color = img.pixelColor(clamp(x + j, img.width() - 1, 0),
-				clamp(y + 1, img.height() - 1, 0));
+				clamp(y + i, img.height() - 1, 0));
 
 			returnR += color.red() * mKernel[idx];
 			returnG += color.green() * mKernel[idx];
@@ -47,18 +122,63 @@ QColor MatrixFilter::calcNewPixelColor(const QImage& img, int x, int y) const {
 		clamp(returnB, 255.f, 0.f));
 }
 
+void MatrixFilter::processGrayRect(const QImage& img, QImage& result, const QRect& rect) const {
+	int size = mKernel.getSize();
+	int radius = mKernel.getRadius();
+	for (int y = rect.top(); y <= rect.bottom(); y++) {
+		uchar* out = result.scanLine(y);
+		for (int x = rect.left(); x <= rect.right(); x++) {
+			float sum = 0;
+			for (int i = -radius; i <= radius; i++) {
+				const uchar* in = img.constScanLine(clamp(y + i, img.height() - 1, 0));
+				for (int j = -radius; j <= radius; j++)
+					sum += in[clamp(x + j, img.width() - 1, 0)] * mKernel[(i + radius) * size + j + radius];
+			}
+			out[x] = static_cast<uchar>(clamp(sum, 255.f, 0.f));
+		}
+	}
+}
+
 //////////
 QColor GrayScale::calcNewPixelColor(const QImage& img, int x, int y) const {
 	QColor color = img.pixelColor(x, y);
-	float intensity = 0.299 * color.red() + 0.587 * color.green() + 0.144 * color.blue();
+	float intensity = 0.299 * color.red() + 0.587 * color.green() + 0.114 * color.blue();
 	color.setRgb(intensity, intensity, intensity);
 	return color;
 }
 
+void GrayScale::processGrayRect(const QImage& img, QImage& result, const QRect& rect) const {
+	for (int y = rect.top(); y <= rect.bottom(); y++)
+		std::copy(img.constScanLine(y) + rect.left(), img.constScanLine(y) + rect.right() + 1, result.scanLine(y) + rect.left());
+}
+
+void GrayScale::toGray(const QImage& img, QImage& gray, const QRect& rect) {
+	QImage rgb = img;
+	if (img.format() != QImage::Format_RGB32 && img.format() != QImage::Format_ARGB32)
+		rgb = img.convertToFormat(QImage::Format_RGB32);
+	for (int y = rect.top(); y <= rect.bottom(); y++) {
+		const QRgb* in = reinterpret_cast<const QRgb*>(rgb.constScanLine(y));
+		uchar* out = gray.scanLine(y);
+		for (int x = rect.left(); x <= rect.right(); x++) {
+			float intensity = 0.299 * qRed(in[x]) + 0.587 * qGreen(in[x]) + 0.114 * qBlue(in[x]);
+			out[x] = static_cast<uchar>(intensity);
+		}
+	}
+}
+
+void GrayScale::toRgb(const QImage& gray, QImage& img, const QRect& rect) {
+	for (int y = rect.top(); y <= rect.bottom(); y++) {
+		const uchar* in = gray.constScanLine(y);
+		QRgb* out = reinterpret_cast<QRgb*>(img.scanLine(y));
+		for (int x = rect.left(); x <= rect.right(); x++)
+			out[x] = qRgb(in[x], in[x], in[x]);
+	}
+}
+
 QColor Sepia::calcNewPixelColor(const QImage& img, int x, int y) const {
 	QColor color = img.pixelColor(x, y);
 	float k = GetK();
-	float intensity = 0.299 * color.red() + 0.587 * color.green() + 0.144 * color.blue();
+	float intensity = 0.299 * color.red() + 0.587 * color.green() + 0.114 * color.blue();
 	color.setRgb(clamp(intensity + 2 * k, 255.f, 0.f),
 		clamp(intensity + 0.5f * k, 255.f, 0.f),
 		clamp(intensity - 1 * k, 255.f, 0.f));
@@ -74,29 +194,33 @@ QColor Brighter::calcNewPixelColor(const QImage& img, int x, int y) const {
 	return color;
 }
 
+void Brighter::processGrayRect(const QImage& img, QImage& result, const QRect& rect) const {
+	for (int y = rect.top(); y <= rect.bottom(); y++) {
+		const uchar* in = img.constScanLine(y);
+		uchar* out = result.scanLine(y);
+		for (int x = rect.left(); x <= rect.right(); x++)
+			out[x] = static_cast<uchar>(clamp(in[x] + k, 255.f, 0.f));
+	}
+}
+
 // ----------------- GrayWorld ---------------------//
-QImage GrayWorld::process(const QImage& img) {
-	//QImage result(img);
+void GrayWorld::prepare(const QImage& img) {
+	//    ,   
+	if (img.format() == QImage::Format_Grayscale8)
+		return;
+	long long sumR = 0, sumG = 0, sumB = 0;
 	int Size = img.width() * img.height();
 	for (int x = 0; x < img.width(); x++)
 		for (int y = 0; y < img.height(); y++) {
-			avgR += img.pixelColor(x, y).red();
-			avgG += img.pixelColor(x, y).green();
-			avgB += img.pixelColor(x, y).blue();
+			QColor color = img.pixelColor(x, y);
+			sumR += color.red();
+			sumG += color.green();
+			sumB += color.blue();
 		}
-	avgR /= Size;
-	avgG /= Size;
-	avgB /= Size;
+	avgR = sumR / Size;
+	avgG = sumG / Size;
+	avgB = sumB / Size;
 	avg = (avgR + avgG + avgB) / 3;
-
-	/*
-	for (int x = 0; x < img.width() / 2; x++)
-		for (int y = 0; y < img.height(); y++) {
-			QColor color = calcNewPixelColor(img, x, y);
-			result.setPixelColor(x, y, color);
-		}
-	*/
-	return Filter::process(img);
 }
 
 QColor GrayWorld::calcNewPixelColor(const QImage& img, int x, int y) const {
@@ -108,25 +232,33 @@ QColor GrayWorld::calcNewPixelColor(const QImage& img, int x, int y) const {
 	return color;
 }
 
+void GrayWorld::processGrayRect(const QImage& img, QImage& result, const QRect& rect) const {
+	for (int y = rect.top(); y <= rect.bottom(); y++)
+		std::copy(img.constScanLine(y) + rect.left(), img.constScanLine(y) + rect.right() + 1, result.scanLine(y) + rect.left());
+}
+
 // ----------------- Transfer -----------------//
 QColor Transfer::calcNewPixelColor(const QImage& img, int x, int y) const {
 	QColor color;
-	if (x + x1 < img.width() && y + y1 < img.height())
+	if (x + x1 >= 0 && x + x1 < img.width() && y + y1 >= 0 && y + y1 < img.height())
 		color = img.pixelColor(x + x1, y + y1);
 	else
 		color.setRgb(0, 0, 0);
 	return color;
 }
 
-QImage Transfer::process(const QImage& img) {
-	QImage result(img);
+void Transfer::processGrayRect(const QImage& img, QImage& result, const QRect& rect) const {
+	for (int y = rect.top(); y <= rect.bottom(); y++) {
+		uchar* out = result.scanLine(y);
+		bool inside = y + y1 >= 0 && y + y1 < img.height();
+		const uchar* in = inside ? img.constScanLine(y + y1) : nullptr;
+		for (int x = rect.left(); x <= rect.right(); x++)
+			out[x] = inside && x + x1 >= 0 && x + x1 < img.width() ? in[x + x1] : 0;
+	}
+}
 
-	for (int x = 0; x < img.width(); x++)
-		for (int y = 0; y < img.height(); y++) {
-			QColor color = Transfer::calcNewPixelColor(img, x, y);
-			result.setPixelColor(x, y, color);
-		}
-	return result;
+QRect Transfer::footprint(const QRect& dirty, const QSize& size) const {
+	return dirty.translated(-x1, -y1);
 }
 
 // ----------------- Glass -----------------//
@@ -140,12 +272,58 @@ QColor Glass::calcNewPixelColor(const QImage& img, int x, int y) const {
 }
 
 // ----------------- LinealStretching -----------------//
+void LinealStretching::prepare(const QImage& img) {
+	float tmpR = 0, tmpG = 0, tmpB = 0;
+	maxR = 0; maxG = 0; maxB = 0;
+	minR = 255; minG = 255; minB = 255;
+	if (img.format() == QImage::Format_Grayscale8) {
+		for (int y = 0; y < img.height(); y++) {
+			const uchar* in = img.constScanLine(y);
+			auto range = std::minmax_element(in, in + img.width());
+			minR = std::min(minR, float(*range.first));
+			maxR = std::max(maxR, float(*range.second));
+		}
+		minG = minB = minR;
+		maxG = maxB = maxR;
+		return;
+	}
+	for (int x = 0; x < img.width(); x++)
+		for (int y = 0; y < img.height(); y++)
+		{
+			QColor color = img.pixelColor(x, y);
+			tmpR = color.red();
+			tmpG = color.green();
+			tmpB = color.blue();
+			if (tmpR > maxR)
+				maxR = tmpR;
+			if (tmpG > maxG)
+				maxG = tmpG;
+			if (tmpB > maxB)
+				maxB = tmpB;
+			if (tmpR < minR)
+				minR = tmpR;
+			if (tmpG < minG)
+				minG = tmpG;
+			if (tmpB < minB)
+				minB = tmpB;
+		}
+}
+
 QColor LinealStretching::calcNewPixelColor(const QImage& img, int x, int y) const {
 	QColor color = img.pixelColor(x, y);
 	color.setRgb(clamp(((color.red() - minR) * 255 / (maxR - minR)), 255.f, 0.f), clamp(((color.green() - minG) * 255 / (maxG - minG)), 255.f, 0.f), clamp(((color.blue() - minB) * 255 / (maxB - minB)), 255.f, 0.f));
 	return color;
 }
 
+void LinealStretching::processGrayRect(const QImage& img, QImage& result, const QRect& rect) const {
+	for (int y = rect.top(); y <= rect.bottom(); y++) {
+		const uchar* in = img.constScanLine(y);
+		uchar* out = result.scanLine(y);
+		for (int x = rect.left(); x <= rect.right(); x++)
+			out[x] = static_cast<uchar>(clamp(((in[x] - minR) * 255 / (maxR - minR)), 255.f, 0.f));
+	}
+}
+
 QColor Dilation::calcNewPixelColor(const QImage& img, int x, int y) const
 {
 	float returnR = 0, tmpR = 0;
@@ -171,6 +349,27 @@ QColor Dilation::calcNewPixelColor(const QImage& img, int x, int y) const
 	return QColor(clamp(returnR, 255.f, 0.f), clamp(returnG, 255.f, 0.f), clamp(returnB, 255.f, 0.f));
 }
 
+void Dilation::processGrayRect(const QImage& img, QImage& result, const QRect& rect) const
+{
+	int size = mKernel.getSize();
+	int radius = mKernel.getRadius();
+	for (int y = rect.top(); y <= rect.bottom(); y++)
+	{
+		uchar* out = result.scanLine(y);
+		for (int x = rect.left(); x <= rect.right(); x++)
+		{
+			float ret = 0;
+			for (int i = -radius; i <= radius; i++)
+			{
+				const uchar* in = img.constScanLine(clamp(y + i, img.height() - 1, 0));
+				for (int j = -radius; j <= radius; j++)
+					ret = std::max(ret, in[clamp(x + j, img.width() - 1, 0)] * mKernel[(i + radius) * size + j + radius]);
+			}
+			out[x] = static_cast<uchar>(clamp(ret, 255.f, 0.f));
+		}
+	}
+}
+
 QColor Erosion::calcNewPixelColor(const QImage& img, int x, int y) const
 {
 	float returnR = 255, tmpR = 0;
@@ -196,6 +395,27 @@ QColor Erosion::calcNewPixelColor(const QImage& img, int x, int y) const
 	return QColor(clamp(returnR, 255.f, 0.f), clamp(returnG, 255.f, 0.f), clamp(returnB, 255.f, 0.f));
 }
 
+void Erosion::processGrayRect(const QImage& img, QImage& result, const QRect& rect) const
+{
+	int size = mKernel.getSize();
+	int radius = mKernel.getRadius();
+	for (int y = rect.top(); y <= rect.bottom(); y++)
+	{
+		uchar* out = result.scanLine(y);
+		for (int x = rect.left(); x <= rect.right(); x++)
+		{
+			float ret = 255;
+			for (int i = -radius; i <= radius; i++)
+			{
+				const uchar* in = img.constScanLine(clamp(y + i, img.height() - 1, 0));
+				for (int j = -radius; j <= radius; j++)
+					ret = std::min(ret, in[clamp(x + j, img.width() - 1, 0)] * mKernel[(i + radius) * size + j + radius]);
+			}
+			out[x] = static_cast<uchar>(clamp(ret, 255.f, 0.f));
+		}
+	}
+}
+
 QColor Opening::calcNewPixelColor(const QImage& img, int x, int y) const
 {
 	QColor a;
@@ -208,49 +428,102 @@ QColor Closing::calcNewPixelColor(const QImage& img, int x, int y) const
 	return a;
 }
 
-QImage Opening::process(const QImage& img) const
+void copyBack(const QImage& part, int dx, int dy, QImage& result, const QRect& rect)
 {
-	QImage result;
-	int rad = mKernel.getRadius();
-	Dilation dil(rad);
-	result = dil.process(img);
-	Erosion eros(rad);
-	result = eros.process(result);
-	return result;
+	if (part.format() == result.format() && part.depth() % 8 == 0)
+	{
+		int bytes = part.depth() / 8;
+		for (int y = rect.top(); y <= rect.bottom(); y++)
+			std::copy(part.constScanLine(y - dy) + (rect.left() - dx) * bytes, part.constScanLine(y - dy) + (rect.right() + 1 - dx) * bytes,
+				result.scanLine(y) + rect.left() * bytes);
+		return;
+	}
+	for (int y = rect.top(); y <= rect.bottom(); y++)
+		for (int x = rect.left(); x <= rect.right(); x++)
+			result.setPixelColor(x, y, part.pixelColor(x - dx, y - dy));
 }
 
-QImage Closing::process(const QImage& img) const
+// first,  second  rect;   rect,    
+static void processTwoPass(const Filter& first, const Filter& second, int rad, const QImage& img, QImage& result, const QRect& rect)
 {
-	QImage result;
-	int rad = mKernel.getRadius();
-	Erosion eros(rad);
-	result = eros.process(img);
-	Dilation dil(rad);
-	result = dil.process(result);
-	return result;
+	QRect area = rect.adjusted(-2 * rad, -2 * rad, 2 * rad, 2 * rad) & img.rect();
+	//    rect    rect,   
+	QRect inner = rect.adjusted(-rad, -rad, rad, rad) & img.rect();
+	int dx = area.left(), dy = area.top();
+	QImage part = area == img.rect() ? img : img.copy(area);
+	QImage tmp(part), out(part);
+	first.processArea(part, tmp, inner.translated(-dx, -dy));
+	second.processArea(tmp, out, rect.translated(-dx, -dy));
+	copyBack(out, dx, dy, result, rect);
+}
+
+void Opening::processRect(const QImage& img, QImage& result, const QRect& rect) const
+{
+	processTwoPass(Dilation(mKernel), Erosion(mKernel), mKernel.getRadius(), img, result, rect);
+}
+
+QRect Opening::footprint(const QRect& dirty, const QSize& size) const
+{
+	int rad = 2 * mKernel.getRadius();
+	return dirty.adjusted(-rad, -rad, rad, rad);
+}
+
+void Closing::processRect(const QImage& img, QImage& result, const QRect& rect) const
+{
+	processTwoPass(Erosion(mKernel), Dilation(mKernel), mKernel.getRadius(), img, result, rect);
+}
+
+QRect Closing::footprint(const QRect& dirty, const QSize& size) const
+{
+	int rad = 2 * mKernel.getRadius();
+	return dirty.adjusted(-rad, -rad, rad, rad);
 }
 
 // ---------------- Grad ----------------- //
-QImage Grad::process(const QImage& img) const
+void Grad::processRect(const QImage& img, QImage& result, const QRect& rect) const
 {
-	QImage tmp1, tmp2, result(img);
 	int rad = mKernel.getRadius();
-	Dilation dil(rad);
-	tmp1 = dil.process(img);
-	Erosion eros(rad);
-	tmp2 = eros.process(img);
-
-	for (int x = 0; x < tmp1.width(); x++)
-		for (int y = 0; y < tmp2.height(); y++)
+	//       rect,   
+	QRect area = rect.adjusted(-rad, -rad, rad, rad) & img.rect();
+	int dx = area.left(), dy = area.top();
+	QImage part = area == img.rect() ? img : img.copy(area);
+	QImage tmp1(part), tmp2(part);
+	Dilation dil(mKernel);
+	dil.processRect(part, tmp1, rect.translated(-dx, -dy));
+	Erosion eros(mKernel);
+	eros.processRect(part, tmp2, rect.translated(-dx, -dy));
+
+	for (int x = rect.left(); x <= rect.right(); x++)
+		for (int y = rect.top(); y <= rect.bottom(); y++)
 		{
-			QColor color1 = tmp1.pixelColor(x, y);
-			QColor color2 = tmp2.pixelColor(x, y);
+			QColor color1 = tmp1.pixelColor(x - dx, y - dy);
+			QColor color2 = tmp2.pixelColor(x - dx, y - dy);
 			QColor res;
 			res.setRgb(clamp(color1.red() - color2.red(), 255, 0), clamp(color1.green() - color2.green(), 255, 0), clamp(color1.blue() - color2.blue(), 255, 0));
 			result.setPixelColor(x, y, res);
 		}
+}
 
-	return result;
+void Grad::processGrayRect(const QImage& img, QImage& result, const QRect& rect) const
+{
+	int rad = mKernel.getRadius();
+	QRect area = rect.adjusted(-rad, -rad, rad, rad) & img.rect();
+	int dx = area.left(), dy = area.top();
+	QImage part = area == img.rect() ? img : img.copy(area);
+	QImage tmp1(part), tmp2(part);
+	Dilation dil(mKernel);
+	dil.processGrayRect(part, tmp1, rect.translated(-dx, -dy));
+	Erosion eros(mKernel);
+	eros.processGrayRect(part, tmp2, rect.translated(-dx, -dy));
+
+	for (int y = rect.top(); y <= rect.bottom(); y++)
+	{
+		const uchar* in1 = tmp1.constScanLine(y - dy);
+		const uchar* in2 = tmp2.constScanLine(y - dy);
+		uchar* out = result.scanLine(y);
+		for (int x = rect.left(); x <= rect.right(); x++)
+			out[x] = clamp(in1[x - dx] - in2[x - dx], 255, 0);
+	}
 }
 
 QColor Grad::calcNewPixelColor(const QImage& img, int x, int y) const
@@ -264,10 +537,12 @@ QColor Median::calcNewPixelColor(const QImage& img, int x, int y) const
 {
 	int size = mKernel.getSize();
 	int radius = mKernel.getRadius();
-	int* masR, * masG, * masB;
-	masR = new int[size * size];
-	masG = new int[size * size];
-	masB = new int[size * size];
+	//      ,       
+	thread_local std::vector<int> scratch;
+	scratch.resize(3 * size * size);
+	int* masR = scratch.data();
+	int* masG = masR + size * size;
+	int* masB = masG + size * size;
 
 	for (int i = -radius; i <= radius; i++)
 		for (int j = -radius; j <= radius; j++)
@@ -287,4 +562,192 @@ QColor Median::calcNewPixelColor(const QImage& img, int x, int y) const
 	col.setRgb(clamp(masR[size * size / 2], 255, 0), clamp(masG[size * size / 2], 255, 0), clamp(masB[size * size / 2], 255, 0));
 
 	return col;
+}
+
+void Median::processGrayRect(const QImage& img, QImage& result, const QRect& rect) const
+{
+	int size = mKernel.getSize();
+	int radius = mKernel.getRadius();
+	thread_local std::vector<uchar> scratch;
+	scratch.resize(size * size);
+
+	for (int y = rect.top(); y <= rect.bottom(); y++)
+	{
+		uchar* out = result.scanLine(y);
+		for (int x = rect.left(); x <= rect.right(); x++)
+		{
+			for (int i = -radius; i <= radius; i++)
+			{
+				const uchar* in = img.constScanLine(clamp(y + i, img.height() - 1, 0));
+				for (int j = -radius; j <= radius; j++)
+					scratch[(i + radius) * size + j + radius] = in[clamp(x + j, img.width() - 1, 0)];
+			}
+			std::nth_element(scratch.begin(), scratch.begin() + size * size / 2, scratch.end());
+			out[x] = scratch[size * size / 2];
+		}
+	}
+}
+
+// -----------    Bilateral  Guided -----------//
+//   area   float (0 - R, 1 - G, 2 - B;     )
+static std::vector<float> readPlane(const QImage& img, const QRect& area, int channel)
+{
+	std::vector<float> plane(area.width() * area.height());
+	bool gray = img.format() == QImage::Format_Grayscale8;
+	for (int y = 0; y < area.height(); y++)
+	{
+		const uchar* line = img.constScanLine(area.top() + y);
+		for (int x = 0; x < area.width(); x++)
+		{
+			if (gray)
+			{
+				plane[y * area.width() + x] = line[area.left() + x];
+				continue;
+			}
+			QRgb color = img.pixel(area.left() + x, area.top() + y);
+			plane[y * area.width() + x] = channel == 0 ? qRed(color) : channel == 1 ? qGreen(color) : qBlue(color);
+		}
+	}
+	return plane;
+}
+
+//    area  ,  result   rect
+template <class PlaneFunc>
+static void processPlanes(const QImage& img, QImage& result, const QRect& rect, const QRect& area, int channels, PlaneFunc func)
+{
+	std::vector<float> planes[3];
+	for (int c = 0; c < channels; c++)
+		planes[c] = func(readPlane(img, area, c), area.width(), area.height());
+
+	auto toByte = [](float v) { return static_cast<int>(clamp(v + 0.5f, 255.f, 0.f)); };
+	for (int y = rect.top(); y <= rect.bottom(); y++)
+		for (int x = rect.left(); x <= rect.right(); x++)
+		{
+			int idx = (y - area.top()) * area.width() + x - area.left();
+			if (channels == 1)
+				result.scanLine(y)[x] = toByte(planes[0][idx]);
+			else
+				result.setPixelColor(x, y, QColor(toByte(planes[0][idx]), toByte(planes[1][idx]), toByte(planes[2][idx])));
+		}
+}
+
+//----------- Bilateral ---------------//
+BilateralFilter::BilateralFilter(std::size_t radius, float sigmaS, float sigmaR)
+	: MatrixFilter(GaussianKernel(radius, sigmaS)), sigmaR(sigmaR), rangeLut(256)
+{
+	for (int d = 0; d < 256; d++)
+		rangeLut[d] = std::exp(-(d * d) / (2 * sigmaR * sigmaR));
+}
+
+//         weights[0..2*radius]
+static void bilateralPass(const std::vector<float>& src, std::vector<float>& dst, int w, int h, bool vertical,
+	const float* weights, int radius, const std::vector<float>& lut)
+{
+	for (int y = 0; y < h; y++)
+		for (int x = 0; x < w; x++)
+		{
+			float center = src[y * w + x];
+			float sum = 0, norm = 0;
+			for (int k = -radius; k <= radius; k++)
+			{
+				int idx = vertical ? clamp(y + k, h - 1, 0) * w + x : y * w + clamp(x + k, w - 1, 0);
+				float v = src[idx];
+				float weight = weights[k + radius] * lut[std::min(static_cast<int>(std::fabs(v - center) + 0.5f), 255)];
+				sum += weight * v;
+				norm += weight;
+			}
+			dst[y * w + x] = sum / norm;
+		}
+}
+
+void BilateralFilter::processRect(const QImage& img, QImage& result, const QRect& rect) const
+{
+	int radius = mKernel.getRadius();
+	//     -   
+	std::vector<float> weights(2 * radius + 1);
+	for (int k = 0; k <= 2 * radius; k++)
+		weights[k] = mKernel[radius * mKernel.getSize() + k];
+
+	QRect area = footprint(rect, img.size()) & img.rect();
+	int channels = img.format() == QImage::Format_Grayscale8 ? 1 : 3;
+	processPlanes(img, result, rect, area, channels, [&](const std::vector<float>& src, int w, int h) {
+		std::vector<float> tmp(src.size()), dst(src.size());
+		bilateralPass(src, tmp, w, h, false, weights.data(), radius, rangeLut);
+		bilateralPass(tmp, dst, w, h, true, weights.data(), radius, rangeLut);
+		return dst;
+	});
+}
+
+void BilateralFilter::processGrayRect(const QImage& img, QImage& result, const QRect& rect) const
+{
+	processRect(img, result, rect);
+}
+
+//----------- Guided ---------------//
+//    (2r+1)x(2r+1),   ,   
+static std::vector<float> boxMean(const std::vector<float>& src, int w, int h, int r)
+{
+	std::vector<float> tmp(src.size()), dst(src.size());
+	std::vector<double> sum(std::max(w, h) + 1);
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++)
+			sum[x + 1] = sum[x] + src[y * w + x];
+		for (int x = 0; x < w; x++)
+		{
+			int lo = std::max(x - r, 0), hi = std::min(x + r, w - 1);
+			tmp[y * w + x] = (sum[hi + 1] - sum[lo]) / (hi - lo + 1);
+		}
+	}
+	for (int x = 0; x < w; x++)
+	{
+		for (int y = 0; y < h; y++)
+			sum[y + 1] = sum[y] + tmp[y * w + x];
+		for (int y = 0; y < h; y++)
+		{
+			int lo = std::max(y - r, 0), hi = std::min(y + r, h - 1);
+			dst[y * w + x] = (sum[hi + 1] - sum[lo]) / (hi - lo + 1);
+		}
+	}
+	return dst;
+}
+
+QRect GuidedFilter::footprint(const QRect& dirty, const QSize& size) const
+{
+	int radius = 2 * mKernel.getRadius();
+	return dirty.adjusted(-radius, -radius, radius, radius);
+}
+
+void GuidedFilter::processRect(const QImage& img, QImage& result, const QRect& rect) const
+{
+	int radius = mKernel.getRadius();
+	float e = eps * 255 * 255;
+	QRect area = footprint(rect, img.size()) & img.rect();
+	int channels = img.format() == QImage::Format_Grayscale8 ? 1 : 3;
+	processPlanes(img, result, rect, area, channels, [&](const std::vector<float>& p, int w, int h) {
+		std::vector<float> sq(p.size());
+		for (std::size_t i = 0; i < p.size(); i++)
+			sq[i] = p[i] * p[i];
+		std::vector<float> mean = boxMean(p, w, h, radius);
+		std::vector<float> corr = boxMean(sq, w, h, radius);
+
+		//    q = a * p + b
+		std::vector<float> a(p.size()), b(p.size());
+		for (std::size_t i = 0; i < p.size(); i++)
+		{
+			float var = corr[i] - mean[i] * mean[i];
+			a[i] = var / (var + e);
+			b[i] = mean[i] - a[i] * mean[i];
+		}
+		std::vector<float> meanA = boxMean(a, w, h, radius);
+		std::vector<float> meanB = boxMean(b, w, h, radius);
+		for (std::size_t i = 0; i < p.size(); i++)
+			a[i] = meanA[i] * p[i] + meanB[i];
+		return a;
+	});
+}
+
+void GuidedFilter::processGrayRect(const QImage& img, QImage& result, const QRect& rect) const
+{
+	processRect(img, result, rect);
 }
\ No newline at end of file
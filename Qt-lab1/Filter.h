@@ -5,18 +5,47 @@
 #include <algorithm>
 #include <time.h>
 #include <fstream>
+#include <memory>
+#include <vector>
 
 class Filter
 {
+public:
+	//     process
+	enum class Region { Full, LeftHalf };
 protected:
+	Region region;
 	virtual QColor calcNewPixelColor(const QImage& img, int x, int y) const = 0;
 public:
+	Filter(Region region = Region::LeftHalf) : region(region) {}
 	virtual ~Filter() = default;
+	void setRegion(Region r) { region = r; }
+	Region getRegion() const { return region; }
+	QRect regionRect(const QSize& size) const;
+
+	//       
+	virtual void prepare(const QImage& img) {}
+	//   rect     result   
+	virtual void processRect(const QImage& img, QImage& result, const QRect& rect) const;
+	//        dirty 
+	virtual QRect footprint(const QRect& dirty, const QSize& size) const { return dirty; }
+
+	//  : img  result   Format_Grayscale8
+	virtual bool supportsGray() const { return false; }
+	virtual void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const {}
+	// processGrayRect   ,  processRect
+	void processArea(const QImage& img, QImage& result, const QRect& rect) const;
+
 	virtual QImage process(const QImage& img);
+	//     dirty  result,   
+	QRect update(const QImage& img, QImage& result, const QRect& dirty);
 };
 
 class InvertFilter : public Filter {
 	QColor calcNewPixelColor(const QImage& img, int x, int y) const override;
+public:
+	bool supportsGray() const override { return true; }
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override;
 };
 
 class Kernel {
@@ -58,6 +87,13 @@ public:
 
 };
 
+//      (  -  ,  )
+bool LoadKernel(const char* path, Kernel& kernel);
+
+//  rect  part (   part   dx, dy)   result,
+//    - 
+void copyBack(const QImage& part, int dx, int dy, QImage& result, const QRect& rect);
+
 class MatrixFilter : public Filter {
 protected:
 	//   ,    Kernel  
@@ -66,6 +102,9 @@ protected:
 public:
 	MatrixFilter(const Kernel& kernel) : mKernel(kernel) {};
 	virtual ~MatrixFilter() = default;
+	QRect footprint(const QRect& dirty, const QSize& size) const override;
+	bool supportsGray() const override { return true; }
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override;
 };
 
 ///--------  ---------///
@@ -113,6 +152,13 @@ public:
 
 class GrayScale : public Filter {
 	QColor calcNewPixelColor(const QImage& img, int x, int y) const override;
+public:
+	//      
+	bool supportsGray() const override { return true; }
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override;
+	//   rect  Format_Grayscale8    RGB
+	static void toGray(const QImage& img, QImage& gray, const QRect& rect);
+	static void toRgb(const QImage& gray, QImage& img, const QRect& rect);
 };
 
 class Sepia : public Filter {
@@ -135,6 +181,8 @@ public:
 	}
 	QColor calcNewPixelColor(const QImage& img, int x, int y) const override;
 	float GetK() const { return k; }
+	bool supportsGray() const override { return true; }
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override;
 };
 
 //----   ----//
@@ -191,8 +239,13 @@ public:
 		avgG = 0;
 		avgB = 0;
 	}
-	QImage process(const QImage& img);
+	void prepare(const QImage& img) override;
+	//     
+	QRect footprint(const QRect& dirty, const QSize& size) const override { return QRect(0, 0, size.width(), size.height()); }
 	QColor calcNewPixelColor(const QImage& img, int x, int y) const override;
+	//      ,    
+	bool supportsGray() const override { return true; }
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override;
 };
 
 
@@ -203,32 +256,20 @@ protected:
 	float minR, minG, minB;
 	QColor calcNewPixelColor(const QImage& img, int x, int y) const override;
 public:
+	LinealStretching()
+	{
+		maxR = 255; maxG = 255; maxB = 255;
+		minR = 0; minG = 0; minB = 0;
+	}
 	LinealStretching(const QImage& img)
 	{
-		float tmpR = 0, tmpG = 0, tmpB = 0;
-		maxR = 0; maxG = 0; maxB = 0;
-		minR = 255; minG = 255; minB = 255;
-		for (int x = 0; x < img.width(); x++)
-			for (int y = 0; y < img.height(); y++)
-			{
-				QColor color = img.pixelColor(x, y);
-				tmpR = color.red();
-				tmpG = color.green();
-				tmpB = color.blue();
-				if (tmpR > maxR)
-					maxR = tmpR;
-				if (tmpG > maxG)
-					maxG = tmpG;
-				if (tmpB > maxB)
-					maxB = tmpB;
-				if (tmpR < minR)
-					minR = tmpR;
-				if (tmpG < minG)
-					minG = tmpG;
-				if (tmpB < minB)
-					minB = tmpB;
-			}
+		prepare(img);
 	}
+	void prepare(const QImage& img) override;
+	//      
+	QRect footprint(const QRect& dirty, const QSize& size) const override { return QRect(0, 0, size.width(), size.height()); }
+	bool supportsGray() const override { return true; }
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override;
 };
 
 // ----------------- Transfer -----------------//
@@ -238,13 +279,15 @@ protected:
 	int x1, y1;
 	
 public:
-	Transfer(int _x1 = 50, int _y1 = 0)
+	Transfer(int _x1 = 50, int _y1 = 0) : Filter(Region::Full)
 	{
 		x1 = _x1;
 		y1 = _y1;
 	}
 	QColor calcNewPixelColor(const QImage& img, int x, int y) const override;
-	QImage process(const QImage& img);
+	QRect footprint(const QRect& dirty, const QSize& size) const override;
+	bool supportsGray() const override { return true; }
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override;
 };
 
 // ----------------- Glass -----------------//
@@ -252,6 +295,9 @@ class Glass : public Filter
 {
 protected:
 	QColor calcNewPixelColor(const QImage& img, int x, int y) const override;
+public:
+	//     5
+	QRect footprint(const QRect& dirty, const QSize& size) const override { return dirty.adjusted(-5, -5, 5, 5); }
 };
 
 // ----------------- dilation, erosion, opening, closing-----------------//
@@ -306,7 +352,8 @@ protected:
 	QColor calcNewPixelColor(const QImage& img, int x, int y) const override;
 public:
 	Dilation(std::size_t radius = 1) :MatrixFilter(DilationKernel(radius)) {}
-	Dilation(Kernel& ker) : MatrixFilter(ker) {}
+	Dilation(const Kernel& ker) : MatrixFilter(ker) {}
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override;
 };
 
 class Erosion : public MatrixFilter
@@ -315,7 +362,8 @@ protected:
 	QColor calcNewPixelColor(const QImage& img, int x, int y) const override;
 public:
 	Erosion(std::size_t radius = 1) : MatrixFilter(ErosionKernel(radius)) {}
-	Erosion(Kernel& ker) : MatrixFilter(ker) {}
+	Erosion(const Kernel& ker) : MatrixFilter(ker) {}
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override;
 };
 
 class Opening : public MatrixFilter
@@ -324,8 +372,10 @@ protected:
 	QColor calcNewPixelColor(const QImage& img, int x, int y) const override;
 public:
 	Opening(std::size_t radius = 1) : MatrixFilter(OpeningKernel(radius)) {}
-	Opening(Kernel& ker) :MatrixFilter(ker) {}
-	QImage process(const QImage& img) const;
+	Opening(const Kernel& ker) :MatrixFilter(ker) {}
+	void processRect(const QImage& img, QImage& result, const QRect& rect) const override;
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override { processRect(img, result, rect); }
+	QRect footprint(const QRect& dirty, const QSize& size) const override;
 };
 
 class Closing : public MatrixFilter
@@ -334,8 +384,10 @@ protected:
 	QColor calcNewPixelColor(const QImage& img, int x, int y) const override;
 public:
 	Closing(std::size_t radius = 1) : MatrixFilter(ClosingKernel(radius)) {}
-	Closing(Kernel& ker) :MatrixFilter(ker) {}
-	QImage process(const QImage& img) const;
+	Closing(const Kernel& ker) :MatrixFilter(ker) {}
+	void processRect(const QImage& img, QImage& result, const QRect& rect) const override;
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override { processRect(img, result, rect); }
+	QRect footprint(const QRect& dirty, const QSize& size) const override;
 };
 
 
@@ -357,9 +409,11 @@ class Grad : public MatrixFilter
 protected:
 	QColor calcNewPixelColor(const QImage& img, int x, int y) const override;
 public:
-	Grad(std::size_t radius = 1) : MatrixFilter(GradKernel(radius)) {}
-	Grad(Kernel& ker) : MatrixFilter(ker) {}
-	QImage process(const QImage& img) const;
+	//      
+	Grad(std::size_t radius = 1) : MatrixFilter(GradKernel(radius)) { setRegion(Region::Full); }
+	Grad(const Kernel& ker) : MatrixFilter(ker) { setRegion(Region::Full); }
+	void processRect(const QImage& img, QImage& result, const QRect& rect) const override;
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override;
 };
 
 // --------------- Median ---------------//
@@ -380,4 +434,36 @@ protected:
 	QColor calcNewPixelColor(const QImage& img, int x, int y) const override;
 public:
 	Median(std::size_t radius = 1) : MatrixFilter(MedianKernel(radius)) {}
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override;
+};
+
+// --------------- Bilateral ---------------//
+//  :    ,   , 
+//  -    ,      .
+class BilateralFilter : public MatrixFilter
+{
+protected:
+	float sigmaR;
+	//     0..255
+	std::vector<float> rangeLut;
+public:
+	BilateralFilter(std::size_t radius = 3, float sigmaS = 3.f, float sigmaR = 30.f);
+	void processRect(const QImage& img, QImage& result, const QRect& rect) const override;
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override;
+};
+
+// --------------- Guided ---------------//
+//        ,
+//      ,     .
+class GuidedFilter : public MatrixFilter
+{
+protected:
+	//      0..1
+	float eps;
+public:
+	GuidedFilter(std::size_t radius = 4, float eps = 0.01f) : MatrixFilter(BlurKernel(radius)), eps(eps) {}
+	//   a  b ,    2 
+	QRect footprint(const QRect& dirty, const QSize& size) const override;
+	void processRect(const QImage& img, QImage& result, const QRect& rect) const override;
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override;
 };
\ No newline at end of file
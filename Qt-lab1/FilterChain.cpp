@@ -0,0 +1,75 @@
+#include "FilterChain.h"
+
+void FilterChain::add(Filter& filter) {
+	filters.push_back(&filter);
+	stages.clear();
+}
+
+void FilterChain::clear() {
+	filters.clear();
+	stages.clear();
+	source = QImage();
+	expanded = QImage();
+	grayStages = 0;
+}
+
+std::size_t FilterChain::countGrayStages() const {
+	if (filters.empty() || !dynamic_cast<GrayScale*>(filters[0]) || filters[0]->getRegion() != Filter::Region::Full)
+		return 0;
+	std::size_t n = 1;
+	while (n < filters.size() && filters[n]->supportsGray())
+		n++;
+	return n;
+}
+
+const QImage& FilterChain::result() const {
+	if (grayStages > 0 && grayStages == stages.size())
+		return expanded;
+	return stages.empty() ? source : stages.back();
+}
+
+QImage FilterChain::process(const QImage& img) {
+	source = img;
+	stages.resize(filters.size());
+	grayStages = countGrayStages();
+	const QImage* input = &source;
+	for (std::size_t i = 0; i < filters.size(); i++) {
+		if (i == 0 && grayStages > 0) {
+			stages[0] = QImage(img.size(), QImage::Format_Grayscale8);
+			GrayScale::toGray(img, stages[0], img.rect());
+		}
+		else
+			stages[i] = filters[i]->process(*input);
+		input = &stages[i];
+		if (i + 1 == grayStages) {
+			expanded = QImage(img.size(), QImage::Format_RGB32);
+			GrayScale::toRgb(stages[i], expanded, img.rect());
+			input = &expanded;
+		}
+	}
+	return result();
+}
+
+QRect FilterChain::update(const QImage& img, const QRect& dirty) {
+	if (stages.size() != filters.size() || source.size() != img.size()) {
+		process(img);
+		return img.rect();
+	}
+
+	//        footprint
+	source = img;
+	QRect changed = dirty & img.rect();
+	const QImage* input = &source;
+	for (std::size_t i = 0; i < filters.size() && !changed.isEmpty(); i++) {
+		if (i == 0 && grayStages > 0)
+			GrayScale::toGray(img, stages[0], changed);
+		else
+			changed = filters[i]->update(*input, stages[i], changed) & img.rect();
+		input = &stages[i];
+		if (i + 1 == grayStages) {
+			GrayScale::toRgb(stages[i], expanded, changed);
+			input = &expanded;
+		}
+	}
+	return changed;
+}
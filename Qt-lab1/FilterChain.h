@@ -0,0 +1,33 @@
+#pragma once
+#include "Filter.h"
+#include <vector>
+
+// ----------------- FilterChain -----------------//
+//      ,
+//         .
+//     GrayScale,      supportsGray
+//     Format_Grayscale8,   RGB    .
+class FilterChain
+{
+protected:
+	std::vector<Filter*> filters;
+	//      
+	std::vector<QImage> stages;
+	QImage source;
+	//            RGB
+	std::size_t grayStages = 0;
+	QImage expanded;
+
+	std::size_t countGrayStages() const;
+public:
+	void add(Filter& filter);
+	void clear();
+	std::size_t size() const { return filters.size(); }
+	std::size_t grayPrefix() const { return grayStages; }
+
+	//     
+	QImage process(const QImage& img);
+	// img       dirty;    
+	QRect update(const QImage& img, const QRect& dirty);
+	const QImage& result() const;
+};
@@ -0,0 +1,197 @@
+#include "Pyramid.h"
+#include <thread>
+
+static const float pyramidKernel[5] = { 1 / 16.f, 4 / 16.f, 6 / 16.f, 4 / 16.f, 1 / 16.f };
+
+static int clampIdx(int value, int max) {
+	return value < 0 ? 0 : value > max ? max : value;
+}
+
+//  [0, rows)     
+template <class RowFunc>
+static void parallelRows(int rows, unsigned threads, RowFunc func)
+{
+	unsigned count = std::max(1u, std::min<unsigned>(threads, rows / 16));
+	if (count == 1) {
+		func(0, rows);
+		return;
+	}
+	std::vector<std::thread> pool;
+	for (unsigned t = 0; t < count; t++)
+		pool.emplace_back(func, rows * t / count, rows * (t + 1) / count);
+	for (std::thread& th : pool)
+		th.join();
+}
+
+ImagePyramid::ImagePyramid(unsigned threads) : threads(threads)
+{
+	if (this->threads == 0)
+		this->threads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ImagePyramid::build(const QImage& img, int levels)
+{
+	gaussian.clear();
+	gaussian.push_back(fromImage(img));
+	while (static_cast<int>(gaussian.size()) < levels && (gaussian.back().width > 1 || gaussian.back().height > 1))
+		gaussian.push_back(reduce(gaussian.back(), threads));
+}
+
+PyramidLevel ImagePyramid::detail(int i) const
+{
+	PyramidLevel result = expand(gaussian[i + 1], gaussian[i].width, gaussian[i].height, threads);
+	for (std::size_t k = 0; k < result.data.size(); k++)
+		result.data[k] = gaussian[i].data[k] - result.data[k];
+	return result;
+}
+
+QImage ImagePyramid::collapse(const PyramidLevel& coarse, int level, float weight) const
+{
+	//  : expand(c) + w * (g[i] - expand(g[i + 1])) = expand(c - w * g[i + 1]) + w * g[i],
+	//       
+	PyramidLevel current = coarse;
+	for (int i = level - 1; i >= 0; i--) {
+		if (weight != 0)
+			for (std::size_t k = 0; k < current.data.size(); k++)
+				current.data[k] -= weight * gaussian[i + 1].data[k];
+		current = expand(current, gaussian[i].width, gaussian[i].height, threads);
+		if (weight != 0)
+			for (std::size_t k = 0; k < current.data.size(); k++)
+				current.data[k] += weight * gaussian[i].data[k];
+	}
+	return toImage(current);
+}
+
+PyramidLevel ImagePyramid::fromImage(const QImage& img)
+{
+	PyramidLevel level;
+	level.width = img.width();
+	level.height = img.height();
+	level.channels = img.format() == QImage::Format_Grayscale8 ? 1 : 3;
+	level.data.resize(level.width * level.height * level.channels);
+	for (int y = 0; y < level.height; y++)
+		for (int x = 0; x < level.width; x++) {
+			float* out = &level.data[(y * level.width + x) * level.channels];
+			if (level.channels == 1) {
+				out[0] = img.constScanLine(y)[x];
+				continue;
+			}
+			QRgb color = img.pixel(x, y);
+			out[0] = qRed(color);
+			out[1] = qGreen(color);
+			out[2] = qBlue(color);
+		}
+	return level;
+}
+
+QImage ImagePyramid::toImage(const PyramidLevel& level)
+{
+	auto toByte = [](float v) { return static_cast<int>(v < 0 ? 0 : v > 255 ? 255 : v + 0.5f); };
+	QImage img(level.width, level.height, level.channels == 1 ? QImage::Format_Grayscale8 : QImage::Format_RGB32);
+	for (int y = 0; y < level.height; y++) {
+		uchar* line = img.scanLine(y);
+		for (int x = 0; x < level.width; x++) {
+			const float* in = &level.data[(y * level.width + x) * level.channels];
+			if (level.channels == 1)
+				line[x] = toByte(in[0]);
+			else
+				reinterpret_cast<QRgb*>(line)[x] = qRgb(toByte(in[0]), toByte(in[1]), toByte(in[2]));
+		}
+	}
+	return img;
+}
+
+PyramidLevel ImagePyramid::reduce(const PyramidLevel& src, unsigned threads)
+{
+	int c = src.channels;
+	PyramidLevel tmp, dst;
+	tmp.width = dst.width = (src.width + 1) / 2;
+	tmp.height = src.height;
+	dst.height = (src.height + 1) / 2;
+	tmp.channels = dst.channels = c;
+	tmp.data.resize(tmp.width * tmp.height * c);
+	dst.data.resize(dst.width * dst.height * c);
+
+	//  :     
+	parallelRows(tmp.height, threads, [&](int y0, int y1) {
+		for (int y = y0; y < y1; y++)
+			for (int x = 0; x < tmp.width; x++)
+				for (int ch = 0; ch < c; ch++) {
+					float sum = 0;
+					for (int k = 0; k < 5; k++)
+						sum += pyramidKernel[k] * src.data[(y * src.width + clampIdx(2 * x + k - 2, src.width - 1)) * c + ch];
+					tmp.data[(y * tmp.width + x) * c + ch] = sum;
+				}
+	});
+	//  :     
+	parallelRows(dst.height, threads, [&](int y0, int y1) {
+		for (int y = y0; y < y1; y++)
+			for (int x = 0; x < dst.width; x++)
+				for (int ch = 0; ch < c; ch++) {
+					float sum = 0;
+					for (int k = 0; k < 5; k++)
+						sum += pyramidKernel[k] * tmp.data[(clampIdx(2 * y + k - 2, tmp.height - 1) * tmp.width + x) * c + ch];
+					dst.data[(y * dst.width + x) * c + ch] = sum;
+				}
+	});
+	return dst;
+}
+
+PyramidLevel ImagePyramid::expand(const PyramidLevel& src, int width, int height, unsigned threads)
+{
+	int c = src.channels;
+	PyramidLevel tmp, dst;
+	tmp.width = dst.width = width;
+	tmp.height = src.height;
+	dst.height = height;
+	tmp.channels = dst.channels = c;
+	tmp.data.resize(tmp.width * tmp.height * c);
+	dst.data.resize(dst.width * dst.height * c);
+
+	//        ,   2   
+	parallelRows(tmp.height, threads, [&](int y0, int y1) {
+		for (int y = y0; y < y1; y++)
+			for (int x = 0; x < tmp.width; x++)
+				for (int ch = 0; ch < c; ch++) {
+					float sum = 0;
+					for (int k = -2; k <= 2; k++)
+						if ((x + k) % 2 == 0)
+							sum += 2 * pyramidKernel[k + 2] * src.data[(y * src.width + clampIdx((x + k) / 2, src.width - 1)) * c + ch];
+					tmp.data[(y * tmp.width + x) * c + ch] = sum;
+				}
+	});
+	parallelRows(dst.height, threads, [&](int y0, int y1) {
+		for (int y = y0; y < y1; y++)
+			for (int x = 0; x < dst.width; x++)
+				for (int ch = 0; ch < c; ch++) {
+					float sum = 0;
+					for (int k = -2; k <= 2; k++)
+						if ((y + k) % 2 == 0)
+							sum += 2 * pyramidKernel[k + 2] * tmp.data[(clampIdx((y + k) / 2, tmp.height - 1) * tmp.width + x) * c + ch];
+					dst.data[(y * dst.width + x) * c + ch] = sum;
+				}
+	});
+	return dst;
+}
+
+// ----------------- MultiScaleFilter -----------------//
+bool MultiScaleFilter::supportsGray() const
+{
+	for (Filter* filter : filters)
+		if (!filter->supportsGray())
+			return false;
+	return true;
+}
+
+void MultiScaleFilter::processRect(const QImage& img, QImage& result, const QRect& rect) const
+{
+	ImagePyramid pyr(threads);
+	pyr.build(img, level + 1);
+	int top = std::min(level, pyr.levels() - 1);
+
+	QImage coarse = pyr.image(top);
+	for (Filter* filter : filters)
+		coarse = filter->process(coarse);
+	QImage full = pyr.collapse(ImagePyramid::fromImage(coarse), top, detail);
+	copyBack(full, 0, 0, result, rect);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "Filter.h"
+#include <vector>
+
+// ----------------- ImagePyramid -----------------//
+//  :   float     (R, G, B   )
+struct PyramidLevel {
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	std::vector<float> data;
+};
+
+//    .    -   1 4 6 4 1,
+//      .
+//    :   -    
+// , collapse     .
+class ImagePyramid
+{
+protected:
+	std::vector<PyramidLevel> gaussian;
+	unsigned threads;
+public:
+	ImagePyramid(unsigned threads = 0);
+	void build(const QImage& img, int levels);
+	int levels() const { return static_cast<int>(gaussian.size()); }
+	const PyramidLevel& level(int i) const { return gaussian[i]; }
+	//  ,   
+	PyramidLevel detail(int i) const;
+	QImage image(int i) const { return toImage(gaussian[i]); }
+	//  coarse   level   ,     weight
+	QImage collapse(const PyramidLevel& coarse, int level, float weight) const;
+
+	static PyramidLevel fromImage(const QImage& img);
+	static QImage toImage(const PyramidLevel& level);
+	static PyramidLevel reduce(const PyramidLevel& src, unsigned threads);
+	static PyramidLevel expand(const PyramidLevel& src, int width, int height, unsigned threads);
+};
+
+// ----------------- MultiScaleFilter -----------------//
+//            .
+//     level    * 2^level   .
+//          .
+class MultiScaleFilter : public Filter
+{
+protected:
+	std::vector<Filter*> filters;
+	int level;
+	// 0 -   , 1 -       
+	float detail;
+	//    , 0 -   
+	unsigned threads;
+	QColor calcNewPixelColor(const QImage& img, int x, int y) const override { return img.pixelColor(x, y); }
+public:
+	MultiScaleFilter(Filter& filter, int level = 1, float detail = 0.f, unsigned threads = 0)
+		: Filter(Region::Full), filters{ &filter }, level(level), detail(detail), threads(threads) {}
+	void add(Filter& filter) { filters.push_back(&filter); }
+	int getLevel() const { return level; }
+	float getDetail() const { return detail; }
+	//     
+	QRect footprint(const QRect& dirty, const QSize& size) const override { return QRect(0, 0, size.width(), size.height()); }
+	void processRect(const QImage& img, QImage& result, const QRect& rect) const override;
+	bool supportsGray() const override;
+	void processGrayRect(const QImage& img, QImage& result, const QRect& rect) const override { processRect(img, result, rect); }
+};
@@ -0,0 +1,247 @@
+#include "Server.h"
+#include <QString>
+#include <sstream>
+#include <cstdlib>
+
+FilterServer::FilterServer(const Kernel& kernel, unsigned threads, std::size_t batch)
+	: matKernel(kernel), batch(batch > 0 ? batch : 1), stopping(false), out(nullptr)
+{
+	filters["invert"] = std::make_unique<InvertFilter>();
+	filters["blur"] = std::make_unique<BlurFilter>();
+	filters["gauss"] = std::make_unique<GaussianFilter>();
+	filters["grayscale"] = std::make_unique<GrayScale>();
+	filters["sepia"] = std::make_unique<Sepia>(10);
+	filters["brighter"] = std::make_unique<Brighter>(50);
+	filters["sharp"] = std::make_unique<SharpFilter>();
+	filters["sobel"] = std::make_unique<SobelFilter>();
+	filters["transfer"] = std::make_unique<Transfer>();
+	filters["glass"] = std::make_unique<Glass>();
+	filters["dilation"] = std::make_unique<Dilation>();
+	filters["erosion"] = std::make_unique<Erosion>();
+	filters["opening"] = std::make_unique<Opening>();
+	filters["closing"] = std::make_unique<Closing>();
+	filters["grad"] = std::make_unique<Grad>();
+	filters["median"] = std::make_unique<Median>();
+	filters["bilateral"] = std::make_unique<BilateralFilter>();
+	filters["guided"] = std::make_unique<GuidedFilter>();
+	//     KernelM.txt
+	filters["kdilation"] = std::make_unique<Dilation>(matKernel);
+	filters["kerosion"] = std::make_unique<Erosion>(matKernel);
+	for (auto& filter : filters)
+		filter.second->setRegion(Filter::Region::Full);
+
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	workers.reserve(threads);
+	for (unsigned i = 0; i < threads; i++)
+		workers.emplace_back(&FilterServer::worker, this, i);
+}
+
+FilterServer::~FilterServer()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCond.notify_all();
+	for (std::thread& t : workers)
+		if (t.joinable())
+			t.join();
+}
+
+int FilterServer::run(std::istream& in, std::ostream& os)
+{
+	out = &os;
+	std::string line;
+	while (std::getline(in, line)) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (line.empty())
+			continue;
+		if (line == "quit")
+			break;
+		if (line == "stats") {
+			printStats();
+			continue;
+		}
+
+		FilterRequest req;
+		std::string chain;
+		std::istringstream tokens(line);
+		if (!(tokens >> req.id >> req.input >> req.output >> chain)) {
+			reply(line + " error bad request");
+			continue;
+		}
+		if (req.input[0] == '@') {
+			long long n = std::strtoll(req.input.c_str() + 1, nullptr, 10);
+			if (n <= 0 || n > maxImageBytes) {
+				//   ,      
+				if (n > 0)
+					in.ignore(static_cast<std::streamsize>(n));
+				reply(req.id + " error bad size");
+				continue;
+			}
+			std::string bytes(static_cast<std::size_t>(n), '\0');
+			in.read(&bytes[0], bytes.size());
+			req.data = QByteArray(bytes.data(), static_cast<int>(in.gcount()));
+		}
+		std::istringstream names(chain);
+		std::string name;
+		while (std::getline(names, name, ','))
+			if (!name.empty())
+				req.chain.push_back(name);
+		req.received = std::chrono::steady_clock::now();
+
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			queue.push_back(std::move(req));
+		}
+		queueCond.notify_one();
+	}
+
+	//    
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCond.notify_all();
+	for (std::thread& t : workers)
+		if (t.joinable())
+			t.join();
+	printStats();
+	return 0;
+}
+
+void FilterServer::worker(unsigned index)
+{
+	srand(static_cast<unsigned>(time(0)) + index);
+	std::vector<FilterRequest> taken;
+	taken.reserve(batch);
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCond.wait(lock, [this] { return stopping || !queue.empty(); });
+			if (queue.empty())
+				return;
+			//    ,    
+			while (!queue.empty() && taken.size() < batch) {
+				taken.push_back(std::move(queue.front()));
+				queue.pop_front();
+			}
+		}
+		for (const FilterRequest& req : taken)
+			handle(req);
+		taken.clear();
+	}
+}
+
+void FilterServer::handle(const FilterRequest& req)
+{
+	QImage img;
+	if (!req.data.isEmpty())
+		img.loadFromData(req.data);
+	else
+		img.load(QString::fromStdString(req.input));
+	if (img.isNull()) {
+		reply(req.id + " error cannot load " + req.input);
+		return;
+	}
+	//  (PNG, GIF)   : setPixelColor    
+	if (img.format() != QImage::Format_Grayscale8)
+		img = img.convertToFormat(img.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+
+	std::string error;
+	QImage result = applyChain(img, req.chain, error);
+	if (!error.empty()) {
+		reply(req.id + " error " + error);
+		return;
+	}
+	if (!result.save(QString::fromStdString(req.output))) {
+		reply(req.id + " error cannot save " + req.output);
+		return;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - req.received).count();
+	{
+		std::lock_guard<std::mutex> lock(outMutex);
+		latencies.push_back(ms);
+	}
+	reply(req.id + " ok " + std::to_string(ms));
+}
+
+QImage FilterServer::applyChain(const QImage& img, const std::vector<std::string>& chain, std::string& error)
+{
+	FilterChain filterChain;
+	// ,    ,    
+	std::vector<std::unique_ptr<Filter>> local;
+	MultiScaleFilter* multi = nullptr;
+	for (const std::string& token : chain) {
+		// @n[:w] -    n-        w
+		std::string name = token.substr(0, token.find('@'));
+		int level = name.size() < token.size() ? std::atoi(token.c_str() + name.size() + 1) : 0;
+		std::size_t colon = token.find(':', name.size());
+		float detail = colon != std::string::npos ? static_cast<float>(std::atof(token.c_str() + colon + 1)) : 0.f;
+
+		Filter* filter = nullptr;
+		auto it = filters.find(name);
+		if (it != filters.end())
+			filter = it->second.get();
+		else if (name == "grayworld")
+			local.push_back(std::make_unique<GrayWorld>());
+		else if (name == "stretching")
+			local.push_back(std::make_unique<LinealStretching>());
+		else {
+			error = "unknown filter " + name;
+			return QImage();
+		}
+		if (!filter) {
+			filter = local.back().get();
+			filter->setRegion(Filter::Region::Full);
+		}
+
+		if (level <= 0) {
+			multi = nullptr;
+			filterChain.add(*filter);
+		}
+		//            
+		else if (multi && multi->getLevel() == level && multi->getDetail() == detail)
+			multi->add(*filter);
+		//       ,    
+		else {
+			local.push_back(std::make_unique<MultiScaleFilter>(*filter, level, detail, 1));
+			multi = static_cast<MultiScaleFilter*>(local.back().get());
+			filterChain.add(*multi);
+		}
+	}
+	return filterChain.process(img);
+}
+
+void FilterServer::reply(const std::string& line)
+{
+	std::lock_guard<std::mutex> lock(outMutex);
+	*out << line << std::endl;
+}
+
+void FilterServer::printStats()
+{
+	std::vector<double> sorted;
+	{
+		std::lock_guard<std::mutex> lock(outMutex);
+		sorted = latencies;
+	}
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&sorted](double p) {
+		if (sorted.empty())
+			return 0.0;
+		std::size_t idx = static_cast<std::size_t>(std::ceil(p / 100 * sorted.size()));
+		return sorted[std::min(std::max<std::size_t>(idx, 1), sorted.size()) - 1];
+	};
+
+	std::ostringstream line;
+	line << "stats n=" << sorted.size()
+		<< " p50=" << percentile(50)
+		<< " p90=" << percentile(90)
+		<< " p99=" << percentile(99)
+		<< " max=" << (sorted.empty() ? 0.0 : sorted.back());
+	reply(line.str());
+}
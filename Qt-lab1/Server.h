@@ -0,0 +1,69 @@
+#pragma once
+#include "Filter.h"
+#include "FilterChain.h"
+#include "Pyramid.h"
+#include <QByteArray>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// ----------------- FilterServer -----------------//
+//  :      ,    stdin.
+//
+//   ( ):
+//   <id> <> <> <>[,<>...]
+//  <> -     @<n>,      n  
+// (  maxImageBytes).
+//    @n[:w]   n-   ,
+// w -      ,   
+// (0   -   , 1 -  ).
+//     n  w   .
+//  : stats -  , quit -    .
+//  ( ): <id> ok <> | <id> error <>
+
+struct FilterRequest {
+	std::string id;
+	std::string input;
+	QByteArray data;
+	std::string output;
+	std::vector<std::string> chain;
+	std::chrono::steady_clock::time_point received;
+};
+
+class FilterServer {
+public:
+	//   ,   stdin
+	static const long long maxImageBytes = 256ll * 1024 * 1024;
+protected:
+	//    ,   
+	std::map<std::string, std::unique_ptr<Filter>> filters;
+	Kernel matKernel;
+
+	std::vector<std::thread> workers;
+	std::size_t batch;
+	std::deque<FilterRequest> queue;
+	bool stopping;
+	std::mutex queueMutex;
+	std::condition_variable queueCond;
+
+	//   , 
+	std::vector<double> latencies;
+	std::mutex outMutex;
+	std::ostream* out;
+
+	void worker(unsigned index);
+	void handle(const FilterRequest& req);
+	QImage applyChain(const QImage& img, const std::vector<std::string>& chain, std::string& error);
+	void reply(const std::string& line);
+	void printStats();
+public:
+	FilterServer(const Kernel& kernel, unsigned threads = 0, std::size_t batch = 1);
+	~FilterServer();
+	int run(std::istream& in, std::ostream& os);
+};
@@ -1,8 +1,14 @@
 #include <QtCore/QCoreApplication>
 #include <QImage>
 #include <string>
+#include <cstring>
 #include "Filter.h"
+#include "Server.h"
 #include <iostream>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 int main(int argc, char* argv[])
 {
@@ -10,32 +16,53 @@ int main(int argc, char* argv[])
     QCoreApplication a(argc, argv);
     std::string s;
     QImage img;
+    bool server = false;
+    int workers = 0;
+    int batch = 1;
 
     for (int i = 0; i < argc; i++) {
         if (!strcmp(argv[i], "-p") && (i + 1 < argc)) {
             s = argv[i + 1];
         }
+        if (!strcmp(argv[i], "-server")) {
+            server = true;
+        }
+        if (!strcmp(argv[i], "-threads") && (i + 1 < argc)) {
+            workers = std::atoi(argv[i + 1]);
+            if (workers <= 0) {
+                std::cerr << "-threads must be a positive number" << std::endl;
+                return 1;
+            }
+        }
+        if (!strcmp(argv[i], "-batch") && (i + 1 < argc)) {
+            batch = std::atoi(argv[i + 1]);
+            if (batch <= 0) {
+                std::cerr << "-batch must be a positive number" << std::endl;
+                return 1;
+            }
+        }
     }
 
-    std::cout << s << std::endl;
-
     // ----- MatKernel ------ //
-    char size[80];
-    std::ifstream ifs("KernelM.txt");
-    ifs.getline(size, 3, '\n');
-    int sizei = std::atoi(size);
-    Kernel MatKernel(sizei);
-    std::unique_ptr<float[]> tmp = std::make_unique<float[]>(sizei * sizei);
-
-    for (int i = 0; i < sizei * sizei; i++)
-    {
-        ifs.getline(size, 2, '\n');
-        tmp[i] = std::atoi(size);
+    Kernel MatKernel(1);
+    if (!LoadKernel("KernelM.txt", MatKernel)) {
+        std::cerr << "cannot read kernel from KernelM.txt (missing file or even/zero size)" << std::endl;
+        return 1;
     }
-
-    MatKernel.SetKernel(tmp.get(), sizei / 2);
     //--------------------------//
 
+    if (server) {
+        // ----- resident mode: filters and kernels stay loaded between requests ----- //
+#ifdef _WIN32
+        // image bytes come through stdin, so it must not translate line endings
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        FilterServer filterServer(MatKernel, workers, batch);
+        return filterServer.run(std::cin, std::cout);
+    }
+
+    std::cout << s << std::endl;
+
     img.load(QString(s.c_str()));
     //img.save("Images/Source.png");
 
@@ -64,7 +91,7 @@ int main(int argc, char* argv[])
     //sobel.process(img).save("Images_2/Sobel.png");
 
     GrayWorld grayWorld;
-   //grayWorld.GrayWorld::process(img).save("Images_2/GrayWorld.png");
+   //grayWorld.process(img).save("Images_2/GrayWorld.png");
 
     Transfer transfer;
     //transfer.process(img).save("Images_2/Transfer.png");